@@ -0,0 +1,48 @@
+#include "BackgroundRestocker.hpp"
+
+// Parameterized Constructor
+BackgroundRestocker::BackgroundRestocker(StationManager &kitchen, std::chrono::milliseconds period)
+    : kitchen_(kitchen), period_(period), stopping_(false), transfers_(0),
+      thread_(&BackgroundRestocker::run, this)
+{
+}
+
+// Destructor
+BackgroundRestocker::~BackgroundRestocker()
+{
+    stop();
+}
+
+// Stops the restock thread
+void BackgroundRestocker::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+// Returns the number of transfers made so far
+unsigned long BackgroundRestocker::getTransfers() const
+{
+    return transfers_;
+}
+
+// Runs a restock pass every period until stopped
+void BackgroundRestocker::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        lock.unlock();
+        transfers_ += kitchen_.restockAhead();
+        lock.lock();
+        wake_.wait_for(lock, period_, [this]
+                       { return stopping_; });
+    }
+}
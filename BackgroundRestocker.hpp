@@ -0,0 +1,60 @@
+#ifndef BACKGROUNDRESTOCKER_HPP
+#define BACKGROUNDRESTOCKER_HPP
+
+#include "StationManager.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * Runs StationManager::restockAhead on its own thread at a fixed period, so
+ * backup transfers happen ahead of demand instead of on the order path.
+ *
+ * While it runs, stock and backup may only be changed through the
+ * StationManager, which serializes its own calls with each pass.
+ */
+class BackgroundRestocker {
+public:
+    /**
+     * Parameterized Constructor
+     * @param kitchen The kitchen to restock. It must outlive the restocker.
+     * @param period The time between restock passes.
+     * @pre: kitchen.setRestockPolicy has been called; until then passes do nothing.
+     * @post: The restock thread is running.
+     */
+    BackgroundRestocker(StationManager& kitchen, std::chrono::milliseconds period);
+
+    /**
+     * Destructor
+     * @post: The restock thread is stopped.
+     */
+    ~BackgroundRestocker();
+
+    BackgroundRestocker(const BackgroundRestocker&) = delete;
+    BackgroundRestocker& operator=(const BackgroundRestocker&) = delete;
+
+    /**
+     * Stops the restock thread after its current pass. Safe to call more than once.
+     */
+    void stop();
+
+    /**
+     * @return The number of transfers made since the restocker started.
+     */
+    unsigned long getTransfers() const;
+
+private:
+    void run();
+
+    StationManager& kitchen_;
+    std::chrono::milliseconds period_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_;
+    std::atomic<unsigned long> transfers_;
+    std::thread thread_;
+};
+
+#endif // BACKGROUNDRESTOCKER_HPP
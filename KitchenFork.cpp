@@ -0,0 +1,402 @@
+#include "KitchenFork.hpp"
+
+namespace
+{
+    // std::queue keeps its deque protected; naming it through a derived type
+    // lets the fork read the manager's queue by position without copying it
+    struct QueueItems : std::queue<Dish *>
+    {
+        static const std::deque<Dish *> &of(const std::queue<Dish *> &queue)
+        {
+            return queue.*&QueueItems::c;
+        }
+    };
+}
+
+// Forks the manager without copying any of its state
+KitchenFork::KitchenFork(StationManager &base)
+    : base_(base), base_version_(0), base_taken_(0), base_dropped_(false)
+{
+    StationManager::KitchenLock lock(base_);
+    base_version_ = base_.version_;
+}
+
+// Returns the fork's copy of a station's stock, copying it on first use
+KitchenFork::StockLevels &KitchenFork::stockFor(KitchenStation *station)
+{
+    auto it = stock_.find(station);
+    if (it == stock_.end())
+    {
+        it = stock_.emplace(station, StationManager::getStockLevels(station)).first;
+    }
+    return it->second;
+}
+
+// Returns the fork's copy of a backup ingredient's entries, copying them on first use
+std::vector<int> &KitchenFork::backupFor(const std::string &ingredient_name)
+{
+    auto it = backup_.find(ingredient_name);
+    if (it == backup_.end())
+    {
+        std::vector<int> entries;
+        for (const Ingredient &ingredient : base_.backup_ingredients_)
+        {
+            if (ingredient.name == ingredient_name)
+            {
+                entries.push_back(ingredient.quantity);
+            }
+        }
+        it = backup_.emplace(ingredient_name, entries).first;
+    }
+    return it->second;
+}
+
+// Counts the manager's dishes still at the front of the fork's queue
+size_t KitchenFork::baseRemaining() const
+{
+    size_t size = base_.dish_queue_.size();
+    return base_dropped_ || base_taken_ >= size ? 0 : size - base_taken_;
+}
+
+// Checks whether the fork's queue is empty
+bool KitchenFork::queueEmpty() const
+{
+    return baseRemaining() == 0 && tail_.empty();
+}
+
+// Returns the front of the fork's queue
+Dish *KitchenFork::queueFront() const
+{
+    return baseRemaining() > 0 ? QueueItems::of(base_.dish_queue_)[base_taken_] : tail_.front();
+}
+
+// Takes the front off the fork's queue without touching the manager's
+void KitchenFork::popQueue()
+{
+    if (baseRemaining() > 0)
+    {
+        base_taken_++;
+    }
+    else
+    {
+        tail_.pop_front();
+    }
+}
+
+// Prepares a dish against the fork's copy of the station's stock
+bool KitchenFork::prepareDishAtStation(const std::string &station_name, const std::string &dish_name)
+{
+    StationManager::KitchenLock lock(base_);
+    KitchenStation *station = base_.findStation(station_name);
+    if (!station)
+    {
+        return false;
+    }
+    Dish *recipe = StationManager::findStationDish(station, dish_name);
+    if (!recipe)
+    {
+        return false;
+    }
+    StockLevels &stock = stockFor(station);
+    if (!StationManager::hasStockFor(stock, recipe))
+    {
+        return false;
+    }
+    // used-up ingredients leave the stock, as they do in KitchenStation::prepareDish
+    for (const Ingredient &ingredient : recipe->getIngredients())
+    {
+        auto it = stock.find(ingredient.name);
+        it->second -= ingredient.required_quantity;
+        if (it->second == 0)
+        {
+            stock.erase(it);
+        }
+    }
+    log_.push_back({false, station_name, dish_name, 0, nullptr});
+    return true;
+}
+
+// Moves stock from the fork's backup to the fork's copy of a station
+bool KitchenFork::replenishStationIngredientFromBackup(const std::string &station_name, const std::string &ingredient_name, int quantity)
+{
+    StationManager::KitchenLock lock(base_);
+    KitchenStation *station = base_.findStation(station_name);
+    if (!station)
+    {
+        return false;
+    }
+    // like the manager, take it all from the first entry that holds enough
+    std::vector<int> &entries = backupFor(ingredient_name);
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (entries[i] >= quantity)
+        {
+            entries[i] -= quantity;
+            if (entries[i] == 0)
+            {
+                entries.erase(entries.begin() + i);
+            }
+            stockFor(station)[ingredient_name] += quantity;
+            log_.push_back({true, station_name, ingredient_name, quantity, nullptr});
+            return true;
+        }
+    }
+    return false;
+}
+
+// Adds a dish to the end of the fork's queue
+void KitchenFork::addDishToQueue(Dish *dish)
+{
+    StationManager::KitchenLock lock(base_);
+    tail_.push_back(dish);
+    added_.push_back(dish);
+}
+
+// Adds an accommodated dish to the end of the fork's queue
+void KitchenFork::addDishToQueue(Dish *dish, Dish::DietaryRequest &request)
+{
+    StationManager::KitchenLock lock(base_);
+    dish->dietaryAccommodations(request);
+    tail_.push_back(dish);
+    added_.push_back(dish);
+}
+
+// Prepares the front of the fork's queue at the first station that can make it
+bool KitchenFork::prepareNextDish()
+{
+    StationManager::KitchenLock lock(base_);
+    if (queueEmpty())
+    {
+        return false;
+    }
+    Dish *dish = queueFront();
+    for (Node<KitchenStation *> *searchptr = base_.getHeadNode(); searchptr != nullptr; searchptr = searchptr->getNext())
+    {
+        if (prepareDishAtStation(searchptr->getItem()->getName(), dish->getName()))
+        {
+            log_.back().dish = dish;
+            popQueue();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Mirrors StationManager::processAllDishes, including its backup top-ups
+int KitchenFork::processAllDishes()
+{
+    StationManager::KitchenLock lock(base_);
+    std::deque<Dish *> dishes;
+    int prepared_count = 0;
+
+    while (!queueEmpty())
+    {
+        Dish *dish = queueFront();
+        popQueue();
+        bool prepared = false;
+
+        for (Node<KitchenStation *> *node = base_.getHeadNode(); node != nullptr && !prepared; node = node->getNext())
+        {
+            KitchenStation *station = node->getItem();
+            if (!StationManager::findStationDish(station, dish->getName()))
+            {
+                continue;
+            }
+            prepared = prepareDishAtStation(station->getName(), dish->getName());
+            if (prepared)
+            {
+                break;
+            }
+
+            // top up the first short ingredient from backup, then retry once
+            const StockLevels &stock = stockFor(station);
+            int diff = 0;
+            std::string name = "";
+            for (const Ingredient &ingredient : dish->getIngredients())
+            {
+                auto it = stock.find(ingredient.name);
+                if (it != stock.end() && it->second < ingredient.required_quantity)
+                {
+                    diff = ingredient.required_quantity - it->second;
+                    name = ingredient.name;
+                    break;
+                }
+            }
+            if (!name.empty() && replenishStationIngredientFromBackup(station->getName(), name, diff))
+            {
+                prepared = prepareDishAtStation(station->getName(), dish->getName());
+            }
+        }
+
+        if (prepared)
+        {
+            log_.back().dish = dish;
+            prepared_count++;
+        }
+        else
+        {
+            dishes.push_back(dish);
+        }
+    }
+
+    // the queue is rebuilt, so it no longer follows the manager's
+    tail_.swap(dishes);
+    base_dropped_ = true;
+    return prepared_count;
+}
+
+// Returns a copy of the fork's queue
+std::queue<Dish *> KitchenFork::getDishQueue() const
+{
+    StationManager::KitchenLock lock(base_);
+    std::queue<Dish *> dishes;
+    const std::deque<Dish *> &base_dishes = QueueItems::of(base_.dish_queue_);
+    for (size_t i = base_dishes.size() - baseRemaining(); i < base_dishes.size(); ++i)
+    {
+        dishes.push(base_dishes[i]);
+    }
+    for (Dish *dish : tail_)
+    {
+        dishes.push(dish);
+    }
+    return dishes;
+}
+
+// Returns the fork's quantity of an ingredient at a station
+int KitchenFork::getStationStock(const std::string &station_name, const std::string &ingredient_name) const
+{
+    StationManager::KitchenLock lock(base_);
+    KitchenStation *station = base_.findStation(station_name);
+    if (!station)
+    {
+        return 0;
+    }
+    auto copied = stock_.find(station);
+    if (copied != stock_.end())
+    {
+        auto it = copied->second.find(ingredient_name);
+        return it == copied->second.end() ? 0 : it->second;
+    }
+    // no copy yet, so read the station itself, summing entries as getStockLevels does
+    int quantity = 0;
+    for (const Ingredient &ingredient : station->getIngredientsStock())
+    {
+        if (ingredient.name == ingredient_name)
+        {
+            quantity += ingredient.quantity;
+        }
+    }
+    return quantity;
+}
+
+// Returns the fork's backup quantity of an ingredient
+int KitchenFork::getBackupStock(const std::string &ingredient_name) const
+{
+    StationManager::KitchenLock lock(base_);
+    auto it = backup_.find(ingredient_name);
+    if (it == backup_.end())
+    {
+        return base_.getBackupIngredientTotal(ingredient_name);
+    }
+    int total = 0;
+    for (int quantity : it->second)
+    {
+        total += quantity;
+    }
+    return total;
+}
+
+// Checks whether the manager changed since the fork was made
+bool KitchenFork::isStale() const
+{
+    StationManager::KitchenLock lock(base_);
+    return base_.version_ != base_version_;
+}
+
+// Replays the fork's changes on the manager and adopts its queue
+bool KitchenFork::commit()
+{
+    StationManager::KitchenLock lock(base_);
+    if (isStale())
+    {
+        return false;
+    }
+    // queued dishes whose prepares ran on the manager, with their counts
+    std::unordered_map<Dish *, int> prepared;
+    bool replayed = true;
+    for (const Operation &operation : log_)
+    {
+        bool applied = operation.transfer
+                           ? base_.replenishStationIngredientFromBackup(operation.station_name, operation.name, operation.quantity)
+                           : base_.prepareDishAtStation(operation.station_name, operation.name);
+        if (!applied)
+        {
+            replayed = false;
+            break;
+        }
+        if (operation.dish)
+        {
+            prepared[operation.dish]++;
+        }
+    }
+
+    bool queue_changed = base_taken_ > 0 || base_dropped_ || !tail_.empty();
+    if (replayed && queue_changed)
+    {
+        // apply the overlay: drop the dishes taken, then append the tail
+        if (base_dropped_)
+        {
+            base_.dish_queue_ = std::queue<Dish *>();
+        }
+        for (size_t i = 0; i < base_taken_ && !base_.dish_queue_.empty(); ++i)
+        {
+            base_.dish_queue_.pop();
+        }
+        for (Dish *dish : tail_)
+        {
+            base_.dish_queue_.push(dish);
+        }
+        ++base_.version_;
+    }
+    else if (!replayed && queue_changed)
+    {
+        // keep every dish, old or added, except those the manager actually prepared
+        std::queue<Dish *> rebuilt;
+        auto keep = [&prepared, &rebuilt](Dish *dish)
+        {
+            auto it = prepared.find(dish);
+            if (it != prepared.end() && it->second > 0)
+            {
+                it->second--;
+                return;
+            }
+            rebuilt.push(dish);
+        };
+        for (std::queue<Dish *> original = base_.dish_queue_; !original.empty(); original.pop())
+        {
+            keep(original.front());
+        }
+        for (Dish *dish : added_)
+        {
+            keep(dish);
+        }
+        base_.dish_queue_.swap(rebuilt);
+        ++base_.version_;
+    }
+    discard();
+    return replayed;
+}
+
+// Drops the fork's changes and re-forks the manager
+void KitchenFork::discard()
+{
+    StationManager::KitchenLock lock(base_);
+    stock_.clear();
+    backup_.clear();
+    base_taken_ = 0;
+    base_dropped_ = false;
+    tail_.clear();
+    log_.clear();
+    added_.clear();
+    base_version_ = base_.version_;
+}
@@ -0,0 +1,168 @@
+#ifndef KITCHENFORK_HPP
+#define KITCHENFORK_HPP
+
+#include "StationManager.hpp"
+#include <deque>
+#include <queue>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A copy-on-write view of a StationManager for dry runs and what-if checks.
+ *
+ * Creating a fork copies nothing. A station's stock or a backup ingredient is
+ * copied into the fork the first time the fork changes it. The dish queue is an
+ * overlay on the manager's: the number of dishes taken off its front and the
+ * dishes added after it. Only processAllDishes, which rebuilds the whole queue,
+ * copies it. So a dry run costs time proportional to what it touches. The
+ * manager itself is never changed until commit() is called.
+ *
+ * The fork keeps each backup entry separate, as the manager does, so a
+ * transfer needs one entry that holds the full quantity.
+ *
+ * Every call holds the manager's kitchen lock while it reads or changes the
+ * manager, so a fork may be used while a BackgroundRestocker runs. A restock
+ * pass in between makes the fork stale, and commit() then refuses it. A fork
+ * itself is not thread-safe; use each fork from one thread.
+ */
+class KitchenFork {
+public:
+    /**
+     * Forks the current state of a station manager.
+     * @param base The manager to fork. It must outlive the fork.
+     * @post: The fork sees exactly the manager's current stock and queue.
+     */
+    explicit KitchenFork(StationManager& base);
+
+    /**
+     * Prepares a dish at a specific station in the fork.
+     * @param station_name A string representing the station's name.
+     * @param dish_name A string representing the name of the dish.
+     * @post: If the dish can be prepared, the fork's copy of the station's stock is reduced.
+     * @return: True if the dish was prepared successfully; false otherwise.
+     */
+    bool prepareDishAtStation(const std::string& station_name, const std::string& dish_name);
+
+    /**
+     * Moves a quantity of an ingredient from the fork's backup stock to a station.
+     * @param station_name A string representing the name of the station.
+     * @param ingredient_name A string representing the name of the ingredient.
+     * @param quantity An integer representing the amount to move.
+     * @return: True if the station exists and the backup had enough; false otherwise.
+     */
+    bool replenishStationIngredientFromBackup(const std::string& station_name, const std::string& ingredient_name, int quantity);
+
+    /**
+     * Adds a dish to the end of the fork's queue.
+     * @param dish A pointer to a dynamically allocated Dish object.
+     * @pre: The dish pointer is not null.
+     */
+    void addDishToQueue(Dish* dish);
+
+    /**
+     * Adds a dish to the end of the fork's queue with dietary accommodations.
+     * @param dish A pointer to a dynamically allocated Dish object.
+     * @param request A DietaryRequest object specifying dietary accommodations.
+     * @pre: The dish pointer is not null.
+     * @post: The dish itself is adjusted right away, as StationManager does.
+     */
+    void addDishToQueue(Dish* dish, Dish::DietaryRequest& request);
+
+    /**
+     * Prepares the next dish in the fork's queue if possible.
+     * @return: True if the dish was prepared and removed; false otherwise.
+     */
+    bool prepareNextDish();
+
+    /**
+     * Runs StationManager::processAllDishes against the fork, without output.
+     * @post: Prepared dishes leave the fork's queue; the rest keep their order.
+     * @return: The number of dishes prepared.
+     */
+    int processAllDishes();
+
+    /**
+     * Retrieves the fork's dish queue.
+     * @return A copy of the queue.
+     */
+    std::queue<Dish*> getDishQueue() const;
+
+    /**
+     * Retrieves the fork's quantity of an ingredient at a station.
+     * @return The quantity, or 0 if the station or ingredient is unknown.
+     */
+    int getStationStock(const std::string& station_name, const std::string& ingredient_name) const;
+
+    /**
+     * Retrieves the fork's backup quantity of an ingredient.
+     * @return The quantity, or 0 if the ingredient is unknown.
+     */
+    int getBackupStock(const std::string& ingredient_name) const;
+
+    /**
+     * Checks whether the manager changed since the fork was made.
+     * @return True if the fork can no longer be committed.
+     */
+    bool isStale() const;
+
+    /**
+     * Applies the fork's changes to the manager.
+     * @post: If the fork is not stale, its prepares and backup transfers are
+     * replayed on the manager in order and the fork's queue replaces the manager's.
+     * If a replayed change fails, replay stops there: the changes before it stay
+     * applied, and the manager's queue becomes its own queue plus the dishes added
+     * in the fork, minus the dishes whose prepares did run.
+     * Either way, the fork is then reset to a fresh fork of the updated manager.
+     * KitchenStation has no stock setter, so commit costs O(operations replayed)
+     * rather than O(1); only discard() is O(1) in the size of the kitchen.
+     * @return: True if every change was applied; false if the fork was stale
+     * (nothing is applied) or a replayed change failed.
+     */
+    bool commit();
+
+    /**
+     * Drops the fork's changes.
+     * @post: The fork is reset to a fresh fork of the manager.
+     */
+    void discard();
+
+private:
+    typedef StationManager::StockLevels StockLevels;
+
+    // a change to replay on the manager at commit time
+    struct Operation {
+        bool transfer;
+        std::string station_name;
+        std::string name;
+        int quantity;
+        // the queued dish a prepare took off the fork's queue, if any
+        Dish* dish;
+    };
+
+    // the fork's copy of a station's stock, made on first use
+    StockLevels& stockFor(KitchenStation* station);
+    // the fork's copy of a backup ingredient's entries, in backup order, made on first use
+    std::vector<int>& backupFor(const std::string& ingredient_name);
+    // the fork's queue, read through the overlay on the manager's
+    bool queueEmpty() const;
+    Dish* queueFront() const;
+    void popQueue();
+    // dishes of the manager's queue still at the front of the fork's
+    size_t baseRemaining() const;
+
+    StationManager& base_;
+    unsigned long base_version_;
+    std::unordered_map<KitchenStation*, StockLevels> stock_;
+    std::unordered_map<std::string, std::vector<int>> backup_;
+    // the fork's queue is the manager's past its first base_taken_ dishes, then
+    // tail_; once processAllDishes rebuilds it, base_dropped_ is set and tail_ holds it all
+    size_t base_taken_;
+    bool base_dropped_;
+    std::deque<Dish*> tail_;
+    std::vector<Operation> log_;
+    // dishes added to the fork's queue, in order
+    std::vector<Dish*> added_;
+};
+
+#endif // KITCHENFORK_HPP
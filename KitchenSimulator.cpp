@@ -0,0 +1,407 @@
+#include "KitchenSimulator.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <ostream>
+#include <sstream>
+
+namespace
+{
+    // trims spaces and tabs from both ends of a field
+    std::string trim(const std::string &field)
+    {
+        size_t first = field.find_first_not_of(" \t\r");
+        if (first == std::string::npos)
+        {
+            return "";
+        }
+        size_t last = field.find_last_not_of(" \t\r");
+        return field.substr(first, last - first + 1);
+    }
+
+    // splits a line on a separator, trimming each field
+    std::vector<std::string> split(const std::string &line, char separator)
+    {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, separator))
+        {
+            fields.push_back(trim(field));
+        }
+        return fields;
+    }
+
+    // parses a whole field as a number
+    bool parseNumber(const std::string &field, long &value)
+    {
+        if (field.empty())
+        {
+            return false;
+        }
+        char *end = nullptr;
+        value = std::strtol(field.c_str(), &end, 10);
+        return *end == '\0';
+    }
+
+    // sets the dietary flag a trace token names
+    bool parseDietaryFlag(const std::string &flag, Dish::DietaryRequest &request)
+    {
+        if (flag == "vegetarian")
+            request.vegetarian = true;
+        else if (flag == "vegan")
+            request.vegan = true;
+        else if (flag == "gluten_free")
+            request.gluten_free = true;
+        else if (flag == "nut_free")
+            request.nut_free = true;
+        else if (flag == "low_sodium")
+            request.low_sodium = true;
+        else if (flag == "low_sugar")
+            request.low_sugar = true;
+        else
+            return false;
+        return true;
+    }
+
+    // the first multiple of interval at or after time
+    long alignUp(long time, long interval)
+    {
+        long ticks = time / interval;
+        if (ticks * interval < time)
+        {
+            ticks++;
+        }
+        return ticks * interval;
+    }
+
+    // nearest-rank percentile of sorted waits
+    long percentile(const std::vector<long> &sorted, double fraction)
+    {
+        if (sorted.empty())
+        {
+            return 0;
+        }
+        size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.999999);
+        return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+    }
+}
+
+// Parameterized Constructor
+KitchenSimulator::KitchenSimulator(StationManager &kitchen, DishFactory make_dish)
+    : kitchen_(kitchen), make_dish_(make_dish), policy_(NEXT_DISH), service_interval_(1), sample_interval_(60)
+{
+}
+
+// Sets the virtual time between service ticks
+void KitchenSimulator::setServiceInterval(long ticks)
+{
+    service_interval_ = std::max(1L, ticks);
+}
+
+// Sets how the queue is worked at each service tick
+void KitchenSimulator::setServicePolicy(ServicePolicy policy)
+{
+    policy_ = policy;
+}
+
+// Sets the virtual time between backup samples
+void KitchenSimulator::setSampleInterval(long ticks)
+{
+    sample_interval_ = std::max(1L, ticks);
+}
+
+// Interns a dish name
+size_t KitchenSimulator::dishIndex(const std::string &dish_name)
+{
+    auto it = dish_indexes_.find(dish_name);
+    if (it != dish_indexes_.end())
+    {
+        return it->second;
+    }
+    dish_names_.push_back(dish_name);
+    dish_indexes_[dish_name] = dish_names_.size() - 1;
+    return dish_names_.size() - 1;
+}
+
+// Adds an order to the trace
+void KitchenSimulator::addOrder(long time, const std::string &dish_name)
+{
+    orders_.push_back({dishIndex(dish_name), false, Dish::DietaryRequest()});
+    trace_.push_back({time, ORDER, orders_.size() - 1});
+}
+
+// Adds an order with dietary accommodations to the trace
+void KitchenSimulator::addOrder(long time, const std::string &dish_name, const Dish::DietaryRequest &request)
+{
+    orders_.push_back({dishIndex(dish_name), true, request});
+    trace_.push_back({time, ORDER, orders_.size() - 1});
+}
+
+// Adds a backup delivery to the trace
+void KitchenSimulator::addRestock(long time, const Ingredient &ingredient)
+{
+    restocks_.push_back(ingredient);
+    trace_.push_back({time, RESTOCK, restocks_.size() - 1});
+}
+
+// Reads a comma-separated trace
+bool KitchenSimulator::loadTrace(std::istream &in)
+{
+    std::string line;
+    while (std::getline(in, line))
+    {
+        line = trim(line);
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        std::vector<std::string> fields = split(line, ',');
+        long time = 0;
+        if (fields.size() < 3 || !parseNumber(fields[1], time) || fields[2].empty())
+        {
+            return false;
+        }
+        if (fields[0] == "order" && fields.size() == 3)
+        {
+            addOrder(time, fields[2]);
+        }
+        else if (fields[0] == "order" && fields.size() == 4)
+        {
+            Dish::DietaryRequest request;
+            for (const std::string &flag : split(fields[3], ';'))
+            {
+                if (!parseDietaryFlag(flag, request))
+                {
+                    return false;
+                }
+            }
+            addOrder(time, fields[2], request);
+        }
+        else if (fields[0] == "restock" && fields.size() == 4)
+        {
+            long quantity = 0;
+            if (!parseNumber(fields[3], quantity) || quantity <= 0)
+            {
+                return false;
+            }
+            Ingredient ingredient;
+            ingredient.name = fields[2];
+            ingredient.quantity = static_cast<int>(quantity);
+            ingredient.required_quantity = 0;
+            addRestock(time, ingredient);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Counts each dish's first try and first failure, whatever the tick count
+void KitchenSimulator::recordAttempt(Queued &queued, bool prepared, Report &report)
+{
+    if (!queued.attempted)
+    {
+        queued.attempted = true;
+        report.prep_attempts++;
+    }
+    if (!prepared && !queued.failed)
+    {
+        queued.failed = true;
+        report.failed_preps++;
+    }
+}
+
+// Works the queue once and records waits for the dishes that leave it
+bool KitchenSimulator::serve(long now, Report &report, std::vector<long> &waits)
+{
+    int prepared = 0;
+    bool moved_backup = false;
+    if (policy_ == NEXT_DISH)
+    {
+        while (!pending_.empty())
+        {
+            bool prepared_front = kitchen_.prepareNextDish();
+            recordAttempt(pending_.front(), prepared_front, report);
+            if (!prepared_front)
+            {
+                break;
+            }
+            waits.push_back(now - pending_.front().arrival);
+            delete pending_.front().dish;
+            pending_.pop_front();
+            prepared++;
+        }
+    }
+    else if (!pending_.empty())
+    {
+        std::ostream discard(nullptr);
+        // a top-up can leave the dish short of another ingredient, so stock may
+        // move even when nothing is prepared
+        long backup_before = backupTotal(report);
+        kitchen_.processAllDishes(discard);
+        moved_backup = backupTotal(report) != backup_before;
+
+        // the dishes left keep their order, so one merge finds the prepared ones
+        std::queue<Dish *> remaining = kitchen_.getDishQueue();
+        std::deque<Queued> kept;
+        for (Queued &queued : pending_)
+        {
+            if (!remaining.empty() && remaining.front() == queued.dish)
+            {
+                recordAttempt(queued, false, report);
+                kept.push_back(queued);
+                remaining.pop();
+            }
+            else
+            {
+                recordAttempt(queued, true, report);
+                waits.push_back(now - queued.arrival);
+                delete queued.dish;
+                prepared++;
+            }
+        }
+        pending_.swap(kept);
+    }
+    report.prepared += prepared;
+    return prepared > 0 || moved_backup;
+}
+
+// Sums the backup stock of every traced ingredient
+long KitchenSimulator::backupTotal(const Report &report) const
+{
+    long total = 0;
+    for (const std::string &name : report.backup_ingredients)
+    {
+        total += kitchen_.getBackupIngredientTotal(name);
+    }
+    return total;
+}
+
+// Records the backup stock of every traced ingredient
+void KitchenSimulator::sample(long now, Report &report) const
+{
+    BackupSample backup;
+    backup.time = now;
+    for (const std::string &name : report.backup_ingredients)
+    {
+        backup.quantities.push_back(kitchen_.getBackupIngredientTotal(name));
+    }
+    report.backup_curve.push_back(backup);
+}
+
+// Replays the trace in virtual time
+KitchenSimulator::Report KitchenSimulator::run()
+{
+    Report report;
+    if (!kitchen_.getDishQueue().empty())
+    {
+        return report;
+    }
+    std::vector<long> waits;
+    std::vector<TraceEvent> trace = trace_;
+    std::stable_sort(trace.begin(), trace.end(), [](const TraceEvent &a, const TraceEvent &b)
+                     { return a.time < b.time; });
+
+    // every ingredient in the backup now or delivered later gets a curve
+    for (const Ingredient &ingredient : kitchen_.getBackupIngredients())
+    {
+        report.backup_ingredients.push_back(ingredient.name);
+    }
+    for (const Ingredient &ingredient : restocks_)
+    {
+        report.backup_ingredients.push_back(ingredient.name);
+    }
+    std::sort(report.backup_ingredients.begin(), report.backup_ingredients.end());
+    report.backup_ingredients.erase(std::unique(report.backup_ingredients.begin(), report.backup_ingredients.end()),
+                                    report.backup_ingredients.end());
+
+    long start = trace.empty() ? 0 : trace.front().time;
+    long next_service = alignUp(start, service_interval_);
+    long next_sample = alignUp(start, sample_interval_);
+    long now = start;
+    size_t next = 0;
+
+    while (true)
+    {
+        long trace_time = next < trace.size() ? trace[next].time : LONG_MAX;
+        now = std::min(trace_time, std::min(next_service, next_sample));
+
+        if (trace_time == now)
+        {
+            const TraceEvent &event = trace[next++];
+            if (event.type == RESTOCK)
+            {
+                kitchen_.addBackupIngredient(restocks_[event.payload]);
+                continue;
+            }
+            Order &order = orders_[event.payload];
+            report.orders++;
+            Dish *dish = make_dish_(dish_names_[order.dish]);
+            if (!dish)
+            {
+                report.unknown_orders++;
+                continue;
+            }
+            if (order.has_request)
+            {
+                Dish::DietaryRequest request = order.request;
+                kitchen_.addDishToQueue(dish, request);
+            }
+            else
+            {
+                kitchen_.addDishToQueue(dish);
+            }
+            pending_.push_back({dish, now, false, false});
+        }
+        else if (next_service == now)
+        {
+            bool changed = serve(now, report, waits);
+            if (next >= trace.size() && (pending_.empty() || !changed))
+            {
+                break;
+            }
+            next_service += service_interval_;
+            // an empty queue, or a tick that changed nothing, stays that way
+            // until the next trace event changes the kitchen, so jump straight to it
+            if ((pending_.empty() || !changed) && next < trace.size() && trace[next].time > next_service)
+            {
+                next_service = alignUp(trace[next].time, service_interval_);
+                next_sample = std::max(next_sample, alignUp(trace[next].time, sample_interval_));
+            }
+        }
+        else
+        {
+            sample(now, report);
+            next_sample += sample_interval_;
+        }
+    }
+    sample(now, report);
+
+    report.duration = now - start;
+    report.left_in_queue = static_cast<int>(pending_.size());
+    if (report.duration > 0)
+    {
+        report.throughput = static_cast<double>(report.prepared) / report.duration;
+    }
+    if (report.prep_attempts > 0)
+    {
+        report.failed_prep_rate = static_cast<double>(report.failed_preps) / report.prep_attempts;
+    }
+    std::sort(waits.begin(), waits.end());
+    report.wait_p50 = percentile(waits, 0.50);
+    report.wait_p90 = percentile(waits, 0.90);
+    report.wait_p99 = percentile(waits, 0.99);
+    report.wait_max = waits.empty() ? 0 : waits.back();
+
+    // the queued dishes belong to the simulator, so they leave with it
+    kitchen_.clearDishQueue();
+    for (const Queued &queued : pending_)
+    {
+        delete queued.dish;
+    }
+    pending_.clear();
+    return report;
+}
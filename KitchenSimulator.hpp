@@ -0,0 +1,195 @@
+#ifndef KITCHENSIMULATOR_HPP
+#define KITCHENSIMULATOR_HPP
+
+#include "StationManager.hpp"
+#include <deque>
+#include <functional>
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * A deterministic discrete-event simulator that replays an order trace
+ * against a StationManager in virtual time.
+ *
+ * The core merges three event streams in time order: the trace (sorted once),
+ * the service ticks and the backup sample ticks. Apart from the dishes it
+ * orders, it allocates nothing per event. After a service tick that leaves the
+ * queue empty, or that neither prepares a dish nor moves backup stock, the
+ * kitchen cannot change before the next trace event, so the simulator skips
+ * straight to it. Under ALL_DISHES a tick may top up a station without
+ * preparing anything, and the next tick then runs as usual.
+ *
+ * Orders go into the kitchen's queue with addDishToQueue when they arrive.
+ * Restocks go into its backup with addBackupIngredient. The queue is worked
+ * at every service tick with prepareNextDish or processAllDishes. Events at
+ * the same virtual time run in the order they were added, and service and
+ * sample ticks run after them.
+ */
+class KitchenSimulator {
+public:
+    /**
+     * How the kitchen works its queue at each service tick.
+     * NEXT_DISH calls prepareNextDish until it fails or the queue is empty.
+     * ALL_DISHES calls processAllDishes once, with its output discarded.
+     */
+    enum ServicePolicy { NEXT_DISH, ALL_DISHES };
+
+    /**
+     * Creates a fresh, heap-allocated dish for an order.
+     * Returns nullptr if the dish is not on the menu.
+     */
+    typedef std::function<Dish*(const std::string&)> DishFactory;
+
+    // backup stock of every traced ingredient at one virtual time
+    struct BackupSample {
+        long time;
+        std::vector<int> quantities;
+    };
+
+    // the results of a run; times are in virtual ticks
+    // prep_attempts counts dishes the kitchen tried at least once, and
+    // failed_preps counts those that failed at least one try, even if
+    // prepared later. Each dish counts once, however many ticks it waits,
+    // so failed_prep_rate does not depend on the service interval.
+    struct Report {
+        long duration = 0;
+        int orders = 0;
+        int unknown_orders = 0;
+        int prepared = 0;
+        int left_in_queue = 0;
+        int prep_attempts = 0;
+        int failed_preps = 0;
+        double throughput = 0;
+        double failed_prep_rate = 0;
+        long wait_p50 = 0;
+        long wait_p90 = 0;
+        long wait_p99 = 0;
+        long wait_max = 0;
+        std::vector<std::string> backup_ingredients;
+        std::vector<BackupSample> backup_curve;
+    };
+
+    /**
+     * Parameterized Constructor
+     * @param kitchen The kitchen to drive. It must outlive the simulator.
+     * @param make_dish Builds the dish for each order.
+     * @post: Service runs every tick with NEXT_DISH, and backup is sampled every 60 ticks.
+     */
+    KitchenSimulator(StationManager& kitchen, DishFactory make_dish);
+
+    /**
+     * Sets the virtual time between service ticks.
+     * @param ticks The interval; values below 1 are treated as 1.
+     */
+    void setServiceInterval(long ticks);
+
+    /**
+     * Sets how the queue is worked at each service tick.
+     */
+    void setServicePolicy(ServicePolicy policy);
+
+    /**
+     * Sets the virtual time between backup samples.
+     * @param ticks The interval; values below 1 are treated as 1.
+     */
+    void setSampleInterval(long ticks);
+
+    /**
+     * Adds an order to the trace.
+     * @param time The virtual arrival time.
+     * @param dish_name The name passed to the dish factory.
+     */
+    void addOrder(long time, const std::string& dish_name);
+
+    /**
+     * Adds an order with dietary accommodations to the trace.
+     * @param time The virtual arrival time.
+     * @param dish_name The name passed to the dish factory.
+     * @param request The accommodations applied when the order is queued.
+     */
+    void addOrder(long time, const std::string& dish_name, const Dish::DietaryRequest& request);
+
+    /**
+     * Adds a delivery to the backup stock to the trace.
+     * @param time The virtual delivery time.
+     * @param ingredient The ingredient and quantity delivered.
+     */
+    void addRestock(long time, const Ingredient& ingredient);
+
+    /**
+     * Reads a trace, one event per line, fields separated by commas:
+     *   order,<time>,<dish name>[,<flag>;<flag>...]
+     *   restock,<time>,<ingredient name>,<quantity>
+     * Flags are vegetarian, vegan, gluten_free, nut_free, low_sodium and low_sugar.
+     * Blank lines and lines starting with '#' are skipped.
+     * @param in The stream to read.
+     * @return True if every line was read; false at the first malformed line.
+     */
+    bool loadTrace(std::istream& in);
+
+    /**
+     * Replays the trace.
+     * @pre: The kitchen's dish queue is empty. If it is not, nothing is run and
+     * an empty report is returned, since the simulator could not tell its own
+     * dishes from the ones already queued.
+     * @post: The kitchen's stock reflects the run. The kitchen's queue is
+     * cleared, because the dishes in it belong to the simulator. The trace is kept,
+     * so run() can be called again on a reset kitchen.
+     * @return The run's report. The run ends at the first service tick after the
+     * last trace event that neither prepares a dish nor moves backup stock.
+     */
+    Report run();
+
+private:
+    enum EventType { RESTOCK, ORDER };
+
+    // one trace entry; payload indexes orders_ or restocks_
+    struct TraceEvent {
+        long time;
+        EventType type;
+        size_t payload;
+    };
+    struct Order {
+        size_t dish;
+        bool has_request;
+        Dish::DietaryRequest request;
+    };
+    // a dish the simulator has queued, with its arrival time
+    struct Queued {
+        Dish* dish;
+        long arrival;
+        bool attempted;
+        bool failed;
+    };
+    // counts a dish's first try and first failure in the report
+    static void recordAttempt(Queued& queued, bool prepared, Report& report);
+
+    // interns a dish name so orders stay small
+    size_t dishIndex(const std::string& dish_name);
+    // works the queue once at virtual time now; returns false if the kitchen did not change
+    bool serve(long now, Report& report, std::vector<long>& waits);
+    // the backup stock of every traced ingredient, summed
+    long backupTotal(const Report& report) const;
+    // records the backup stock of every traced ingredient
+    void sample(long now, Report& report) const;
+
+    StationManager& kitchen_;
+    DishFactory make_dish_;
+    ServicePolicy policy_;
+    long service_interval_;
+    long sample_interval_;
+
+    std::vector<TraceEvent> trace_;
+    std::vector<std::string> dish_names_;
+    std::unordered_map<std::string, size_t> dish_indexes_;
+    std::vector<Order> orders_;
+    std::vector<Ingredient> restocks_;
+
+    // the simulator's mirror of the kitchen queue, oldest first; the
+    // simulator owns these dishes and deletes each one as it leaves
+    std::deque<Queued> pending_;
+};
+
+#endif // KITCHENSIMULATOR_HPP
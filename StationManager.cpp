@@ -3,7 +3,38 @@ Sharafat Hussin
 11/30/24
 */
 #include "StationManager.hpp"
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <iostream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    // set on worker threads of processAllDishesParallel, whose caller holds the kitchen lock
+    thread_local bool kitchen_lock_held_by_caller = false;
+}
+
+// Locks the kitchen mutex unless this thread works for a caller that holds it
+StationManager::KitchenLock::KitchenLock(const StationManager &manager)
+    : mutex_(kitchen_lock_held_by_caller ? nullptr : &manager.kitchen_mutex_.mutex)
+{
+    if (mutex_)
+    {
+        mutex_->lock();
+    }
+}
+
+StationManager::KitchenLock::~KitchenLock()
+{
+    if (mutex_)
+    {
+        mutex_->unlock();
+    }
+}
 
 // Default Constructor
 StationManager::StationManager()
@@ -14,16 +45,28 @@ StationManager::StationManager()
 // Adds a new station to the station manager
 bool StationManager::addStation(KitchenStation *station)
 {
-    return insert(item_count_, station);
+    KitchenLock lock(*this);
+    if (station == nullptr || !insert(item_count_, station))
+    {
+        return false;
+    }
+    addStationStockToTotals(station, 1);
+    ++version_;
+    return true;
 }
 
 // Removes a station from the station manager by name
 bool StationManager::removeStation(const std::string &station_name)
 {
+    KitchenLock lock(*this);
     for (int i = 0; i < item_count_; ++i)
     {
         if (getEntry(i)->getName() == station_name)
         {
+            addStationStockToTotals(getEntry(i), -1);
+            station_profiles_.erase(station_name);
+            station_demand_.erase(station_name);
+            ++version_;
             return remove(i);
         }
     }
@@ -48,6 +91,7 @@ KitchenStation *StationManager::findStation(const std::string &station_name) con
 // Moves a specified station to the front of the station manager list
 bool StationManager::moveStationToFront(const std::string &station_name)
 {
+    KitchenLock lock(*this);
     // First, make sure the station exists
     if (findStation(station_name) == nullptr)
     {
@@ -74,6 +118,7 @@ bool StationManager::moveStationToFront(const std::string &station_name)
 
             // Insert the station at the front
             insert(0, station);
+            ++version_;
 
             return true; // Exit after moving the station
         }
@@ -100,9 +145,23 @@ int StationManager::getStationIndex(const std::string &name) const
     return -1;
 }
 
+// Finds the station's own copy of a dish, which is what prepareDish consumes
+Dish *StationManager::findStationDish(KitchenStation *station, const std::string &dish_name)
+{
+    for (Dish *dish : station->getDishes())
+    {
+        if (dish->getName() == dish_name)
+        {
+            return dish;
+        }
+    }
+    return nullptr;
+}
+
 // Merges the dishes and ingredients of two specified stations
 bool StationManager::mergeStations(const std::string &station_name1, const std::string &station_name2)
 {
+    KitchenLock lock(*this);
     KitchenStation *station1 = findStation(station_name1);
     KitchenStation *station2 = findStation(station_name2);
     if (station1 && station2)
@@ -116,7 +175,19 @@ bool StationManager::mergeStations(const std::string &station_name1, const std::
         for (Ingredient ingredient : station2->getIngredientsStock())
         {
             station1->replenishStationIngredients(ingredient);
+            adjustStationTotal(ingredient.name, ingredient.quantity);
+        }
+        // station1 takes over station2's slots and any prep times it lacks
+        int slots = getStationSlots(station_name1) + getStationSlots(station_name2);
+        StationProfile &profile1 = station_profiles_[station_name1];
+        profile1.slots = slots;
+        auto profile2 = station_profiles_.find(station_name2);
+        if (profile2 != station_profiles_.end())
+        {
+            profile1.prep_times.insert(profile2->second.prep_times.begin(), profile2->second.prep_times.end());
         }
+        // station1 now serves station2's orders too, so it inherits its demand
+        mergeDemand(station_name1, station_name2);
         // remove station2 from the list
         removeStation(station_name2);
         return true;
@@ -127,9 +198,11 @@ bool StationManager::mergeStations(const std::string &station_name1, const std::
 // Assigns a dish to a specific station
 bool StationManager::assignDishToStation(const std::string &station_name, Dish *dish)
 {
+    KitchenLock lock(*this);
     KitchenStation *station = findStation(station_name);
     if (station)
     {
+        ++version_;
         return station->assignDishToStation(dish);
     }
     return false;
@@ -138,10 +211,12 @@ bool StationManager::assignDishToStation(const std::string &station_name, Dish *
 // Replenishes an ingredient at a specific station
 bool StationManager::replenishIngredientAtStation(const std::string &station_name, const Ingredient &ingredient)
 {
+    KitchenLock lock(*this);
     KitchenStation *station = findStation(station_name);
     if (station)
     {
         station->replenishStationIngredients(ingredient);
+        adjustStationTotal(ingredient.name, ingredient.quantity);
         return true;
     }
     return false;
@@ -150,6 +225,7 @@ bool StationManager::replenishIngredientAtStation(const std::string &station_nam
 // Checks if any station in the station manager can complete an order for a specific dish
 bool StationManager::canCompleteOrder(const std::string &dish_name) const
 {
+    KitchenLock lock(*this);
     Node<KitchenStation *> *searchptr = getHeadNode();
     while (searchptr != nullptr)
     {
@@ -165,10 +241,28 @@ bool StationManager::canCompleteOrder(const std::string &dish_name) const
 // Prepares a dish at a specific station if possible
 bool StationManager::prepareDishAtStation(const std::string &station_name, const std::string &dish_name)
 {
+    KitchenLock lock(*this);
     KitchenStation *station = findStation(station_name);
-    if (station && station->canCompleteOrder(dish_name))
+    if (station && station->canCompleteOrder(dish_name) && station->prepareDish(dish_name))
     {
-        return station->prepareDish(dish_name);
+        Dish *dish = findStationDish(station, dish_name);
+        if (dish)
+        {
+            for (const Ingredient &ingredient : dish->getIngredients())
+            {
+                adjustStationTotal(ingredient.name, -ingredient.required_quantity);
+            }
+            std::lock_guard<std::mutex> inventory_lock(inventory_mutex_.mutex);
+            for (const Ingredient &ingredient : dish->getIngredients())
+            {
+                consumed_totals_[ingredient.name] += ingredient.required_quantity;
+            }
+            if (restocking_enabled_)
+            {
+                recordDemand(station_name, dish);
+            }
+        }
+        return true;
     }
     return false;
 }
@@ -181,6 +275,7 @@ bool StationManager::prepareDishAtStation(const std::string &station_name, const
 
 std::queue<Dish *> StationManager::getDishQueue()
 {
+    KitchenLock lock(*this);
     return (dish_queue_);
 }
 
@@ -193,6 +288,7 @@ supplies.
 
 std::vector<Ingredient> StationManager::getBackupIngredients()
 {
+    KitchenLock lock(*this);
     return (backup_ingredients_);
 }
 
@@ -207,7 +303,9 @@ queue.
 
 void StationManager::setDishQueue(std::queue<Dish *> &dish_queue)
 {
+    KitchenLock lock(*this);
     dish_queue_.swap(dish_queue);
+    ++version_;
 }
 
 /**
@@ -225,7 +323,9 @@ Task 4: Implement the displayDishQueue Function.
 */
 void StationManager::setBackupIngredients(const std::vector<Ingredient> &backup_ingredients)
 {
+    KitchenLock lock(*this);
     backup_ingredients_ = backup_ingredients;
+    rebuildBackupTotals();
 }
 
 /**
@@ -237,7 +337,9 @@ void StationManager::setBackupIngredients(const std::vector<Ingredient> &backup_
 
 void StationManager::addDishToQueue(Dish *dish)
 {
+    KitchenLock lock(*this);
     dish_queue_.push(dish);
+    ++version_;
 }
 
 /**
@@ -252,8 +354,10 @@ the end of the queue.
 
 void StationManager::addDishToQueue(Dish *dish, Dish::DietaryRequest &request)
 {
+    KitchenLock lock(*this);
     dish->dietaryAccommodations(request);
     dish_queue_.push(dish);
+    ++version_;
 }
 
 /**
@@ -265,6 +369,7 @@ void StationManager::addDishToQueue(Dish *dish, Dish::DietaryRequest &request)
  */
 bool StationManager::prepareNextDish()
 {
+    KitchenLock lock(*this);
     if(dish_queue_.empty()){
         return(false);
     }
@@ -276,6 +381,7 @@ bool StationManager::prepareNextDish()
         if (prepareDishAtStation(station_name, dish->getName()))
         {
             dish_queue_.pop();
+            ++version_;
             return true;
         }
        searchptr=searchptr->getNext();
@@ -307,10 +413,12 @@ void StationManager::displayDishQueue()
  */
 void StationManager::clearDishQueue()
 {
+    KitchenLock lock(*this);
     while (!dish_queue_.empty())
     {
         dish_queue_.pop();
     }
+    ++version_;
 }
 
 /**
@@ -337,25 +445,38 @@ void StationManager::clearDishQueue()
 */
 bool StationManager::replenishStationIngredientFromBackup(const std::string& station_name, const std::string& ingredient_name, int quantity)
 {
+    KitchenLock lock(*this);
         if(!findStation(station_name)){
         return(false);
     }
-    for(size_t i=0; i<backup_ingredients_.size();i++)
+    Ingredient new_ingredient;
+    bool taken = false;
     {
-
-       if (backup_ingredients_[i].name == ingredient_name && backup_ingredients_[i].quantity >= quantity)
+        // the backup is shared by the groups of processAllDishesParallel
+        std::lock_guard<std::mutex> inventory_lock(inventory_mutex_.mutex);
+        for(size_t i=0; i<backup_ingredients_.size();i++)
         {
-            Ingredient new_ingredient = backup_ingredients_[i];
-            new_ingredient.quantity = quantity;
-            backup_ingredients_[i].quantity -= quantity;
-            if(backup_ingredients_[i].quantity == 0){
-                backup_ingredients_.erase(backup_ingredients_.begin() + i);
+
+           if (backup_ingredients_[i].name == ingredient_name && backup_ingredients_[i].quantity >= quantity)
+            {
+                new_ingredient = backup_ingredients_[i];
+                new_ingredient.quantity = quantity;
+                backup_ingredients_[i].quantity -= quantity;
+                if(backup_ingredients_[i].quantity == 0){
+                    backup_ingredients_.erase(backup_ingredients_.begin() + i);
+                }
+                taken = true;
+                break;
             }
-            this->replenishIngredientAtStation(station_name, new_ingredient);
-            return true;
         }
     }
-    return false;
+    if (!taken)
+    {
+        return false;
+    }
+    adjustBackupTotal(ingredient_name, -quantity);
+    this->replenishIngredientAtStation(station_name, new_ingredient);
+    return true;
 }
 
 /**
@@ -370,11 +491,13 @@ ingredients.
 
 bool StationManager::addBackupIngredients(const std::vector<Ingredient>& ingredients)
 {
+    KitchenLock lock(*this);
     /*if (ingredients.empty())
     {
         return false;    
     }*/
     backup_ingredients_ = ingredients;
+    rebuildBackupTotals();
         return true;
     /*for(auto& ingredient: ingredients){
         if(!addBackupIngredient(ingredient)){
@@ -396,16 +519,19 @@ is increased by the ingredient's quantity.
 
 bool StationManager::addBackupIngredient(const Ingredient& ingredient)
 {
+    KitchenLock lock(*this);
     
     for (auto& i : backup_ingredients_)
     {
         if (i.name == ingredient.name)
         {
             i.quantity += ingredient.quantity;
+            adjustBackupTotal(ingredient.name, ingredient.quantity);
             return true;
         }
     }
     backup_ingredients_.push_back(ingredient);
+    adjustBackupTotal(ingredient.name, ingredient.quantity);
     return true;
 }
 
@@ -416,7 +542,13 @@ bool StationManager::addBackupIngredient(const Ingredient& ingredient)
 
 void StationManager::clearBackupIngredients()
 {
+    KitchenLock lock(*this);
     backup_ingredients_.clear();
+    for (auto &total : backup_totals_)
+    {
+        total.second = 0;
+    }
+    ++version_;
 }
 
 /**
@@ -433,82 +565,776 @@ void StationManager::clearBackupIngredients()
     *  maintaining the same order as before.
     */
 void StationManager::processAllDishes() {
+    processAllDishes(std::cout);
+}
+
+// Processes all dishes in the queue, writing the results to out
+void StationManager::processAllDishes(std::ostream &out) {
+    KitchenLock lock(*this);
     std::queue<Dish *> dishes;
    
     while (!dish_queue_.empty()) {
         Dish *dish = dish_queue_.front();
-        bool prepared = false;
-        Node<KitchenStation *> *currentNode = this->getHeadNode();
+        dish_queue_.pop();
+        if (!processQueuedDish(dish, out)) {
+            dishes.push(dish);
+        }
+    }
 
-        std::cout << "PREPARING DISH: " << dish->getName() << std::endl;
+    dish_queue_ = dishes;
+    ++version_;
+    out << "All dishes have been processed." << std::endl;
+}
 
-        while (currentNode != nullptr) {
-            KitchenStation *station = currentNode->getItem();
-            currentNode = currentNode->getNext();
-            
-            std::cout << station->getName() << " attempting to prepare " << dish->getName() << "..." << std::endl;
-            
-            bool found = false;
-            for (auto item : station->getDishes()) {
-                if (dish->getName() == item->getName()) {
-                    found = true;
-                    break;
-                }
+// Processes all dishes on a thread pool, printing the results to std::cout
+void StationManager::processAllDishesParallel(size_t threads) {
+    processAllDishesParallel(threads, std::cout);
+}
+
+// Processes independent groups of dishes in parallel, with sequential output
+void StationManager::processAllDishesParallel(size_t threads, std::ostream &out) {
+    KitchenLock lock(*this);
+    std::vector<Dish *> dishes;
+    while (!dish_queue_.empty()) {
+        dishes.push_back(dish_queue_.front());
+        dish_queue_.pop();
+    }
+    std::vector<KitchenStation *> stations;
+    for (Node<KitchenStation *> *node = getHeadNode(); node != nullptr; node = node->getNext()) {
+        stations.push_back(node->getItem());
+    }
+
+    // union-find over dishes, then stations, then backup ingredient names
+    std::vector<size_t> parent(dishes.size() + stations.size());
+    std::iota(parent.begin(), parent.end(), 0);
+    std::unordered_map<std::string, size_t> ingredient_nodes;
+    auto root = [&parent](size_t node) {
+        while (parent[node] != node) {
+            parent[node] = parent[parent[node]];
+            node = parent[node];
+        }
+        return node;
+    };
+    auto unite = [&](size_t a, size_t b) {
+        parent[root(a)] = root(b);
+    };
+    for (size_t i = 0; i < dishes.size(); ++i) {
+        bool stationed = false;
+        for (size_t s = 0; s < stations.size(); ++s) {
+            if (findStationDish(stations[s], dishes[i]->getName())) {
+                unite(i, dishes.size() + s);
+                stationed = true;
             }
-            if (!found) {
-                std::cout << station->getName() << ": Dish not available. Moving to next station..." << std::endl;
-                continue;
+        }
+        // only a dish some station makes can pull its ingredients from backup
+        if (!stationed) {
+            continue;
+        }
+        for (const Ingredient &ingredient : dishes[i]->getIngredients()) {
+            auto it = ingredient_nodes.find(ingredient.name);
+            if (it == ingredient_nodes.end()) {
+                parent.push_back(parent.size());
+                it = ingredient_nodes.emplace(ingredient.name, parent.size() - 1).first;
+            }
+            unite(i, it->second);
+        }
+    }
+
+    std::unordered_map<size_t, size_t> group_of_root;
+    std::vector<std::vector<size_t>> groups;
+    for (size_t i = 0; i < dishes.size(); ++i) {
+        auto it = group_of_root.emplace(root(i), groups.size()).first;
+        if (it->second == groups.size()) {
+            groups.emplace_back();
+        }
+        groups[it->second].push_back(i);
+    }
+
+    std::vector<std::string> outputs(dishes.size());
+    std::vector<char> prepared(dishes.size(), 0);
+    std::vector<std::function<void()>> tasks;
+    for (const std::vector<size_t> &group : groups) {
+        tasks.push_back([this, &group, &dishes, &outputs, &prepared]() {
+            kitchen_lock_held_by_caller = true;
+            for (size_t i : group) {
+                std::ostringstream dish_out;
+                prepared[i] = processQueuedDish(dishes[i], dish_out);
+                outputs[i] = dish_out.str();
             }
+            kitchen_lock_held_by_caller = false;
+        });
+    }
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, tasks.size());
+    if (threads <= 1) {
+        for (const std::function<void()> &task : tasks) {
+            task();
+        }
+    } else {
+        WorkStealingPool pool(threads);
+        pool.run(tasks);
+    }
 
-            prepared = this->prepareDishAtStation(station->getName(), dish->getName());
-            if (prepared) {
-                std::cout << station->getName() << ": Successfully prepared " << dish->getName() << "." << std::endl;
-                dish_queue_.pop();
+    for (size_t i = 0; i < dishes.size(); ++i) {
+        out << outputs[i];
+        if (!prepared[i]) {
+            dish_queue_.push(dishes[i]);
+        }
+    }
+    ++version_;
+    out << "All dishes have been processed." << std::endl;
+}
+
+// Tries every station for one queued dish, topping up from backup once per station
+bool StationManager::processQueuedDish(Dish *dish, std::ostream &out) {
+    bool prepared = false;
+    Node<KitchenStation *> *currentNode = this->getHeadNode();
+
+    out << "PREPARING DISH: " << dish->getName() << std::endl;
+
+    while (currentNode != nullptr) {
+        KitchenStation *station = currentNode->getItem();
+        currentNode = currentNode->getNext();
+        
+        out << station->getName() << " attempting to prepare " << dish->getName() << "..." << std::endl;
+        
+        bool found = false;
+        for (auto item : station->getDishes()) {
+            if (dish->getName() == item->getName()) {
+                found = true;
                 break;
             }
+        }
+        if (!found) {
+            out << station->getName() << ": Dish not available. Moving to next station..." << std::endl;
+            continue;
+        }
 
-            int diff = 0;
-            std::string name = "";
-            for (const Ingredient &ingredient : dish->getIngredients()) {
-                for (const Ingredient &stock_ingredient : station->getIngredientsStock()) {
-                    if (stock_ingredient.name == ingredient.name && stock_ingredient.quantity < ingredient.required_quantity) {
-                        diff = ingredient.required_quantity - stock_ingredient.quantity;
-                        name = ingredient.name;
-                        break;
-                    }
-                }
-                if (!name.empty()) {
+        prepared = this->prepareDishAtStation(station->getName(), dish->getName());
+        if (prepared) {
+            out << station->getName() << ": Successfully prepared " << dish->getName() << "." << std::endl;
+            break;
+        }
+
+        int diff = 0;
+        std::string name = "";
+        for (const Ingredient &ingredient : dish->getIngredients()) {
+            for (const Ingredient &stock_ingredient : station->getIngredientsStock()) {
+                if (stock_ingredient.name == ingredient.name && stock_ingredient.quantity < ingredient.required_quantity) {
+                    diff = ingredient.required_quantity - stock_ingredient.quantity;
+                    name = ingredient.name;
                     break;
                 }
             }
-
             if (!name.empty()) {
-                std::cout << station->getName() << ": Insufficient ingredients. Replenishing ingredients..." << std::endl;
-                bool replenished = replenishStationIngredientFromBackup(station->getName(), name, diff);
-                
-                if (replenished) {
-                    std::cout << station->getName() << ": Ingredients replenished." << std::endl;
-                    prepared = this->prepareDishAtStation(station->getName(), dish->getName());
-                    if (prepared) {
-                        std::cout << station->getName() << ": Successfully prepared " << dish->getName() << "." << std::endl;
-                        dish_queue_.pop();
-                        break;
-                    } else {
-                        std::cout << station->getName() << ": Dish not available. Moving to next station..." << std::endl;
-                    }
+                break;
+            }
+        }
+
+        if (!name.empty()) {
+            out << station->getName() << ": Insufficient ingredients. Replenishing ingredients..." << std::endl;
+            bool replenished = replenishStationIngredientFromBackup(station->getName(), name, diff);
+            
+            if (replenished) {
+                out << station->getName() << ": Ingredients replenished." << std::endl;
+                prepared = this->prepareDishAtStation(station->getName(), dish->getName());
+                if (prepared) {
+                    out << station->getName() << ": Successfully prepared " << dish->getName() << "." << std::endl;
+                    break;
                 } else {
-                    std::cout << station->getName() << ": Unable to replenish ingredients. Failed to prepare " << dish->getName() << "." << std::endl;
+                    out << station->getName() << ": Dish not available. Moving to next station..." << std::endl;
                 }
+            } else {
+                out << station->getName() << ": Unable to replenish ingredients. Failed to prepare " << dish->getName() << "." << std::endl;
             }
         }
+    }
 
-        if (!prepared) {
-            std::cout << dish->getName() << " was not prepared." << std::endl;
-            dishes.push(dish);
-            dish_queue_.pop();
+    if (!prepared) {
+        out << dish->getName() << " was not prepared." << std::endl;
+    }
+    return prepared;
+}
+
+// Returns the kitchen-wide total of an ingredient (stations plus backup)
+int StationManager::getIngredientTotal(const std::string &ingredient_name) const
+{
+    KitchenLock lock(*this);
+    return getStationIngredientTotal(ingredient_name) + getBackupIngredientTotal(ingredient_name);
+}
+
+// Returns the total of an ingredient summed over all stations
+int StationManager::getStationIngredientTotal(const std::string &ingredient_name) const
+{
+    KitchenLock lock(*this);
+    auto it = station_totals_.find(ingredient_name);
+    return it == station_totals_.end() ? 0 : it->second;
+}
+
+// Returns the total of an ingredient held in the backup stock
+int StationManager::getBackupIngredientTotal(const std::string &ingredient_name) const
+{
+    KitchenLock lock(*this);
+    auto it = backup_totals_.find(ingredient_name);
+    return it == backup_totals_.end() ? 0 : it->second;
+}
+
+// Lists every known ingredient whose kitchen-wide total is below threshold
+std::vector<std::string> StationManager::getIngredientsBelowThreshold(int threshold) const
+{
+    KitchenLock lock(*this);
+    std::vector<std::string> below;
+    for (const auto &total : station_totals_)
+    {
+        if (getIngredientTotal(total.first) < threshold)
+        {
+            below.push_back(total.first);
+        }
+    }
+    // ingredients that only ever appeared in the backup stock
+    for (const auto &total : backup_totals_)
+    {
+        if (station_totals_.count(total.first) == 0 && total.second < threshold)
+        {
+            below.push_back(total.first);
+        }
+    }
+    std::sort(below.begin(), below.end());
+    return below;
+}
+
+// Lists up to n of the most consumed ingredients, most consumed first
+std::vector<std::pair<std::string, int>> StationManager::getTopConsumedIngredients(size_t n) const
+{
+    KitchenLock lock(*this);
+    std::vector<std::pair<std::string, int>> consumed(consumed_totals_.begin(), consumed_totals_.end());
+    auto more_consumed = [](const std::pair<std::string, int> &a, const std::pair<std::string, int> &b)
+    {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    };
+    n = std::min(n, consumed.size());
+    std::partial_sort(consumed.begin(), consumed.begin() + n, consumed.end(), more_consumed);
+    consumed.resize(n);
+    return consumed;
+}
+
+// Applies a change in station stock to the kitchen-wide totals
+void StationManager::adjustStationTotal(const std::string &ingredient_name, int delta)
+{
+    std::lock_guard<std::mutex> lock(inventory_mutex_.mutex);
+    station_totals_[ingredient_name] += delta;
+    ++version_;
+}
+
+// Applies a change in backup stock to the kitchen-wide totals
+void StationManager::adjustBackupTotal(const std::string &ingredient_name, int delta)
+{
+    std::lock_guard<std::mutex> lock(inventory_mutex_.mutex);
+    backup_totals_[ingredient_name] += delta;
+    ++version_;
+}
+
+// Adds (sign = 1) or removes (sign = -1) a whole station's stock from the totals
+void StationManager::addStationStockToTotals(KitchenStation *station, int sign)
+{
+    for (const Ingredient &ingredient : station->getIngredientsStock())
+    {
+        adjustStationTotal(ingredient.name, sign * ingredient.quantity);
+    }
+}
+
+// Recomputes the backup totals after the backup stock is replaced wholesale
+void StationManager::rebuildBackupTotals()
+{
+    for (auto &total : backup_totals_)
+    {
+        total.second = 0;
+    }
+    for (const Ingredient &ingredient : backup_ingredients_)
+    {
+        adjustBackupTotal(ingredient.name, ingredient.quantity);
+    }
+    ++version_;
+}
+
+// Copies a station's stock into a name -> quantity map
+StationManager::StockLevels StationManager::getStockLevels(KitchenStation *station)
+{
+    StockLevels stock;
+    for (const Ingredient &ingredient : station->getIngredientsStock())
+    {
+        stock[ingredient.name] += ingredient.quantity;
+    }
+    return stock;
+}
+
+// Checks whether the stock covers one serving of a recipe
+bool StationManager::hasStockFor(const StockLevels &stock, Dish *recipe)
+{
+    for (const Ingredient &ingredient : recipe->getIngredients())
+    {
+        auto it = stock.find(ingredient.name);
+        if (it == stock.end() || it->second < ingredient.required_quantity)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Removes the ingredients of a number of servings from the stock
+void StationManager::takeStock(StockLevels &stock, Dish *recipe, int servings)
+{
+    for (const Ingredient &ingredient : recipe->getIngredients())
+    {
+        stock[ingredient.name] -= servings * ingredient.required_quantity;
+    }
+}
+
+// Sets the number of parallel slots of a station
+bool StationManager::setStationSlots(const std::string &station_name, int slots)
+{
+    if (slots < 1 || !findStation(station_name))
+    {
+        return false;
+    }
+    station_profiles_[station_name].slots = slots;
+    return true;
+}
+
+// Returns the number of parallel slots of a station
+int StationManager::getStationSlots(const std::string &station_name) const
+{
+    auto it = station_profiles_.find(station_name);
+    return it == station_profiles_.end() ? 1 : it->second.slots;
+}
+
+// Sets the time a station takes to prepare a dish
+bool StationManager::setDishPrepTime(const std::string &station_name, const std::string &dish_name, int prep_time)
+{
+    if (prep_time < 1 || !findStation(station_name))
+    {
+        return false;
+    }
+    station_profiles_[station_name].prep_times[dish_name] = prep_time;
+    return true;
+}
+
+// Returns the time a station takes to prepare a dish
+int StationManager::getDishPrepTime(const std::string &station_name, const std::string &dish_name) const
+{
+    auto profile = station_profiles_.find(station_name);
+    if (profile == station_profiles_.end())
+    {
+        return 1;
+    }
+    auto it = profile->second.prep_times.find(dish_name);
+    return it == profile->second.prep_times.end() ? 1 : it->second;
+}
+
+// Plans a window of the queue across station slots to minimize the batch makespan
+std::vector<StationManager::DishAssignment> StationManager::planBatchAssignment(size_t window) const
+{
+    KitchenLock lock(*this);
+    // improving moves allowed per planned dish, which bounds the runtime
+    const size_t kMovesPerDish = 4;
+
+    std::vector<Dish *> batch;
+    std::queue<Dish *> queued = dish_queue_;
+    while (!queued.empty() && batch.size() < window)
+    {
+        batch.push_back(queued.front());
+        queued.pop();
+    }
+
+    struct PlanStation
+    {
+        KitchenStation *station;
+        StockLevels stock;
+        std::vector<int> slot_loads;
+    };
+    std::vector<PlanStation> stations;
+    for (Node<KitchenStation *> *searchptr = getHeadNode(); searchptr != nullptr; searchptr = searchptr->getNext())
+    {
+        KitchenStation *station = searchptr->getItem();
+        stations.push_back({station, getStockLevels(station), std::vector<int>(getStationSlots(station->getName()), 0)});
+    }
+
+    // every station that has the dish on its menu, with its recipe and prep time
+    struct Candidate
+    {
+        size_t station;
+        Dish *recipe;
+        int prep_time;
+    };
+    std::vector<std::vector<Candidate>> candidates(batch.size());
+    std::vector<int> shortest(batch.size(), 0);
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        for (size_t s = 0; s < stations.size(); ++s)
+        {
+            Dish *recipe = findStationDish(stations[s].station, batch[i]->getName());
+            if (recipe)
+            {
+                int prep_time = getDishPrepTime(stations[s].station->getName(), batch[i]->getName());
+                candidates[i].push_back({s, recipe, prep_time});
+                if (shortest[i] == 0 || prep_time < shortest[i])
+                {
+                    shortest[i] = prep_time;
+                }
+            }
+        }
+    }
+
+    // longest dishes first; the stable sort keeps queue order among equals
+    std::vector<size_t> order(batch.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&shortest](size_t a, size_t b)
+                     { return shortest[a] > shortest[b]; });
+
+    auto least_loaded = [](const std::vector<int> &loads)
+    {
+        return static_cast<int>(std::min_element(loads.begin(), loads.end()) - loads.begin());
+    };
+
+    // greedy pass: each dish goes to the feasible slot where it finishes first
+    struct Placement
+    {
+        int candidate = -1;
+        int slot = -1;
+    };
+    std::vector<Placement> placed(batch.size());
+    for (size_t i : order)
+    {
+        int best_finish = 0;
+        for (size_t c = 0; c < candidates[i].size(); ++c)
+        {
+            const Candidate &candidate = candidates[i][c];
+            PlanStation &plan = stations[candidate.station];
+            if (!hasStockFor(plan.stock, candidate.recipe))
+            {
+                continue;
+            }
+            int slot = least_loaded(plan.slot_loads);
+            int finish = plan.slot_loads[slot] + candidate.prep_time;
+            if (placed[i].candidate < 0 || finish < best_finish)
+            {
+                placed[i].candidate = static_cast<int>(c);
+                placed[i].slot = slot;
+                best_finish = finish;
+            }
+        }
+        if (placed[i].candidate >= 0)
+        {
+            const Candidate &candidate = candidates[i][placed[i].candidate];
+            PlanStation &plan = stations[candidate.station];
+            takeStock(plan.stock, candidate.recipe, 1);
+            plan.slot_loads[placed[i].slot] = best_finish;
+        }
+    }
+
+    // improvement pass: move dishes off the busiest slot while that shortens it
+    for (size_t move = 0; move < kMovesPerDish * batch.size(); ++move)
+    {
+        size_t busy_station = 0;
+        int busy_slot = -1;
+        int makespan = 0;
+        for (size_t s = 0; s < stations.size(); ++s)
+        {
+            for (size_t k = 0; k < stations[s].slot_loads.size(); ++k)
+            {
+                if (stations[s].slot_loads[k] > makespan)
+                {
+                    busy_station = s;
+                    busy_slot = static_cast<int>(k);
+                    makespan = stations[s].slot_loads[k];
+                }
+            }
+        }
+        if (busy_slot < 0)
+        {
+            break;
+        }
+
+        bool improved = false;
+        for (size_t i = 0; i < batch.size() && !improved; ++i)
+        {
+            if (placed[i].candidate < 0)
+            {
+                continue;
+            }
+            const Candidate &current = candidates[i][placed[i].candidate];
+            if (current.station != busy_station || placed[i].slot != busy_slot)
+            {
+                continue;
+            }
+            for (size_t c = 0; c < candidates[i].size() && !improved; ++c)
+            {
+                const Candidate &target = candidates[i][c];
+                PlanStation &plan = stations[target.station];
+                std::vector<int> &loads = plan.slot_loads;
+                int slot = least_loaded(loads);
+                if (target.station == busy_station && slot == busy_slot)
+                {
+                    continue;
+                }
+                if (target.station != busy_station && !hasStockFor(plan.stock, target.recipe))
+                {
+                    continue;
+                }
+                if (std::max(makespan - current.prep_time, loads[slot] + target.prep_time) >= makespan)
+                {
+                    continue;
+                }
+                takeStock(stations[busy_station].stock, current.recipe, -1);
+                stations[busy_station].slot_loads[busy_slot] -= current.prep_time;
+                takeStock(plan.stock, target.recipe, 1);
+                loads[slot] += target.prep_time;
+                placed[i].candidate = static_cast<int>(c);
+                placed[i].slot = slot;
+                improved = true;
+            }
+        }
+        if (!improved)
+        {
+            break;
+        }
+    }
+
+    // each slot runs its dishes in queue order
+    std::vector<DishAssignment> assignments;
+    std::vector<std::vector<int>> slot_clock(stations.size());
+    for (size_t s = 0; s < stations.size(); ++s)
+    {
+        slot_clock[s].assign(stations[s].slot_loads.size(), 0);
+    }
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        if (placed[i].candidate < 0)
+        {
+            continue;
         }
+        const Candidate &candidate = candidates[i][placed[i].candidate];
+        int &clock = slot_clock[candidate.station][placed[i].slot];
+        assignments.push_back({batch[i], i, stations[candidate.station].station->getName(),
+                               placed[i].slot, clock, clock + candidate.prep_time});
+        clock += candidate.prep_time;
     }
+    std::stable_sort(assignments.begin(), assignments.end(), [](const DishAssignment &a, const DishAssignment &b)
+                     { return a.start_time < b.start_time; });
+    return assignments;
+}
 
+// Prepares a planned window of the queue, keeping unprepared dishes in order
+int StationManager::prepareQueuedBatch(size_t window)
+{
+    KitchenLock lock(*this);
+    std::vector<DishAssignment> assignments = planBatchAssignment(window);
+    std::vector<bool> prepared(std::min(window, dish_queue_.size()), false);
+    int prepared_count = 0;
+    for (const DishAssignment &assignment : assignments)
+    {
+        if (prepareDishAtStation(assignment.station_name, assignment.dish->getName()))
+        {
+            prepared[assignment.queue_position] = true;
+            prepared_count++;
+        }
+    }
+
+    std::queue<Dish *> dishes;
+    for (size_t i = 0; !dish_queue_.empty(); ++i)
+    {
+        if (i >= prepared.size() || !prepared[i])
+        {
+            dishes.push(dish_queue_.front());
+        }
+        dish_queue_.pop();
+    }
     dish_queue_ = dishes;
-    std::cout << "All dishes have been processed." << std::endl;
+    ++version_;
+    return prepared_count;
+}
+
+// Turns on consumption tracking and ahead-of-demand restocking
+void StationManager::setRestockPolicy(const RestockPolicy &policy)
+{
+    KitchenLock lock(*this);
+    std::lock_guard<std::mutex> inventory_lock(inventory_mutex_.mutex);
+    restock_policy_ = policy;
+    restock_policy_.smoothing = std::min(1.0, std::max(0.0, policy.smoothing));
+    restock_policy_.horizon = std::max(0, policy.horizon);
+    restocking_enabled_ = true;
+}
+
+// Turns off consumption tracking and forgets the learned rates
+void StationManager::disableRestocking()
+{
+    KitchenLock lock(*this);
+    std::lock_guard<std::mutex> inventory_lock(inventory_mutex_.mutex);
+    restocking_enabled_ = false;
+    station_demand_.clear();
+}
+
+// Returns a station's smoothed use of an ingredient per prepare
+double StationManager::getConsumptionRate(const std::string &station_name, const std::string &ingredient_name) const
+{
+    KitchenLock lock(*this);
+    auto demand = station_demand_.find(station_name);
+    if (demand == station_demand_.end())
+    {
+        return 0;
+    }
+    auto rate = demand->second.rates.find(ingredient_name);
+    return rate == demand->second.rates.end() ? 0 : currentRate(demand->second, rate->second);
+}
+
+// Folds one prepare into the station's EWMA of each ingredient's use
+void StationManager::recordDemand(const std::string &station_name, Dish *recipe)
+{
+    StationDemand &demand = station_demand_[station_name];
+    demand.prepares++;
+    for (const Ingredient &ingredient : recipe->getIngredients())
+    {
+        DemandRate &rate = demand.rates[ingredient.name];
+        // every prepare since the last update, this one included, decays the old rate
+        rate.rate = restock_policy_.smoothing * ingredient.required_quantity + currentRate(demand, rate);
+        rate.last_prepare = demand.prepares;
+    }
+}
+
+// Decays a stored rate to the station's latest prepare
+double StationManager::currentRate(const StationDemand &demand, const DemandRate &rate) const
+{
+    unsigned long idle = demand.prepares - rate.last_prepare;
+    if (rate.last_prepare == 0 || idle == 0)
+    {
+        return rate.rate;
+    }
+    return rate.rate * std::pow(1.0 - restock_policy_.smoothing, static_cast<double>(idle));
+}
+
+// Folds a station's demand into another's as one prepare-weighted history
+void StationManager::mergeDemand(const std::string &into_name, const std::string &from_name)
+{
+    std::lock_guard<std::mutex> inventory_lock(inventory_mutex_.mutex);
+    auto from = station_demand_.find(from_name);
+    if (from == station_demand_.end() || from->second.prepares == 0)
+    {
+        return;
+    }
+    // references survive the rehash an insert into station_demand_ may cause
+    const StationDemand &from_demand = from->second;
+    StationDemand &into = station_demand_[into_name];
+    StationDemand merged;
+    merged.prepares = into.prepares + from_demand.prepares;
+    // each rate is use per prepare, so weight each side by its share of the prepares
+    const StationDemand *sides[] = {&into, &from_demand};
+    for (const StationDemand *demand : sides)
+    {
+        double weight = static_cast<double>(demand->prepares) / merged.prepares;
+        for (const auto &rate : demand->rates)
+        {
+            DemandRate &merged_rate = merged.rates[rate.first];
+            merged_rate.rate += weight * currentRate(*demand, rate.second);
+            merged_rate.last_prepare = merged.prepares;
+        }
+    }
+    into = merged;
+}
+
+// Takes up to quantity of an ingredient from the backup, across entries
+int StationManager::takeFromBackup(const std::string &ingredient_name, int quantity, Ingredient &taken)
+{
+    int moved = 0;
+    {
+        std::lock_guard<std::mutex> inventory_lock(inventory_mutex_.mutex);
+        for (size_t i = 0; i < backup_ingredients_.size() && moved < quantity;)
+        {
+            if (backup_ingredients_[i].name != ingredient_name)
+            {
+                i++;
+                continue;
+            }
+            if (moved == 0)
+            {
+                taken = backup_ingredients_[i];
+            }
+            int amount = std::min(quantity - moved, backup_ingredients_[i].quantity);
+            backup_ingredients_[i].quantity -= amount;
+            moved += amount;
+            if (backup_ingredients_[i].quantity <= 0)
+            {
+                backup_ingredients_.erase(backup_ingredients_.begin() + i);
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+    if (moved > 0)
+    {
+        adjustBackupTotal(ingredient_name, -moved);
+        taken.quantity = moved;
+    }
+    return moved;
+}
+
+// Tops up every station whose projected stock would cross the low-water mark
+int StationManager::restockAhead()
+{
+    KitchenLock lock(*this);
+    if (!restocking_enabled_)
+    {
+        return 0;
+    }
+
+    // one request per short (station, ingredient), in station order
+    struct Request
+    {
+        std::string station_name;
+        std::string ingredient_name;
+        int quantity;
+    };
+    std::vector<Request> requests;
+    for (Node<KitchenStation *> *searchptr = getHeadNode(); searchptr != nullptr; searchptr = searchptr->getNext())
+    {
+        KitchenStation *station = searchptr->getItem();
+        auto demand = station_demand_.find(station->getName());
+        if (demand == station_demand_.end())
+        {
+            continue;
+        }
+        StockLevels stock = getStockLevels(station);
+        for (const auto &rate : demand->second.rates)
+        {
+            double expected = currentRate(demand->second, rate.second) * restock_policy_.horizon;
+            auto on_hand = stock.find(rate.first);
+            int quantity = on_hand == stock.end() ? 0 : on_hand->second;
+            if (expected <= 0 || quantity - expected >= restock_policy_.low_water_mark)
+            {
+                continue;
+            }
+            int needed = static_cast<int>(std::ceil(restock_policy_.low_water_mark + expected - quantity));
+            requests.push_back({station->getName(), rate.first, std::max(1, needed)});
+        }
+    }
+
+    int transfers = 0;
+    for (const Request &request : requests)
+    {
+        Ingredient taken;
+        if (takeFromBackup(request.ingredient_name, request.quantity, taken) > 0)
+        {
+            replenishIngredientAtStation(request.station_name, taken);
+            transfers++;
+        }
+    }
+    return transfers;
 }
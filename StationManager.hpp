@@ -11,11 +11,43 @@ Sharafat Hussin
 #include "Appetizer.hpp"
 #include "MainCourse.hpp"
 #include "Dessert.hpp"
+#include <mutex>
+#include <ostream>
 #include <string>
 #include<queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class KitchenFork;
 
 class StationManager : public LinkedList<KitchenStation*> {
 public:
+    /**
+     * A planned placement of a queued dish on one of a station's parallel slots.
+     * Times are in minutes from the start of the batch.
+     */
+    struct DishAssignment {
+        Dish* dish;
+        size_t queue_position;
+        std::string station_name;
+        int slot;
+        int start_time;
+        int finish_time;
+    };
+
+    /**
+     * Settings for demand-forecast restocking.
+     * smoothing is the EWMA weight given to the newest prepare, in (0, 1].
+     * A station is topped up once its stock, less the demand projected over
+     * the next horizon prepares at that station, would fall below low_water_mark.
+     */
+    struct RestockPolicy {
+        double smoothing = 0.2;
+        int low_water_mark = 5;
+        int horizon = 10;
+    };
+
     /**
      * Default Constructor
      * @post: Initializes an empty stationn manager.
@@ -258,11 +290,254 @@ void clearBackupIngredients();
 
 void processAllDishes();
 
+/**
+* Processes all dishes in the queue, writing the detailed results to a stream.
+* @param out The stream that receives the same lines processAllDishes() prints.
+* @post: Same as processAllDishes().
+*/
+void processAllDishes(std::ostream& out);
+
+/**
+* Processes all dishes in the queue like processAllDishes, running
+* independent dishes on a work-stealing thread pool.
+* @param threads The number of worker threads; 0 means one per hardware thread.
+* @param out The stream that receives the results.
+* @pre: No other StationManager call runs while this one does.
+* @post: The queue, the stock, the backup and the output are byte-for-byte what
+* processAllDishes would produce. Two dishes are placed in the same group whenever
+* they could use the same station or draw the same ingredient from backup.
+* Each group runs in queue order on one thread, and the output is written
+* in queue order once every group is done.
+*/
+void processAllDishesParallel(size_t threads, std::ostream& out);
+
+/**
+* Processes all dishes in parallel, printing the results to std::cout.
+* @param threads The number of worker threads; 0 means one per hardware thread.
+*/
+void processAllDishesParallel(size_t threads = 0);
+
+/**
+* Retrieves the kitchen-wide quantity of an ingredient.
+* @param ingredient_name The name of the ingredient.
+* @return The quantity held across all stations plus the backup stock.
+* @post: Inventory is unchanged. Runs in O(1).
+* Note: totals track stock changed through the StationManager; stock changed
+* directly through a KitchenStation pointer is not seen.
+*/
+int getIngredientTotal(const std::string& ingredient_name) const;
+
+/**
+* Retrieves the quantity of an ingredient summed over all stations.
+* @param ingredient_name The name of the ingredient.
+* @return The station quantity, or 0 if the ingredient is unknown.
+*/
+int getStationIngredientTotal(const std::string& ingredient_name) const;
+
+/**
+* Retrieves the quantity of an ingredient in the backup stock.
+* @param ingredient_name The name of the ingredient.
+* @return The backup quantity, or 0 if the ingredient is unknown.
+*/
+int getBackupIngredientTotal(const std::string& ingredient_name) const;
+
+/**
+* Lists the ingredients whose kitchen-wide total is below a threshold.
+* @param threshold The par level to compare against.
+* @return The names of every known ingredient (including depleted ones) whose
+* total is strictly less than threshold, sorted by name.
+*/
+std::vector<std::string> getIngredientsBelowThreshold(int threshold) const;
+
+/**
+* Lists the most consumed ingredients since the manager was created.
+* @param n The maximum number of ingredients to return.
+* @return Up to n (name, consumed quantity) pairs, most consumed first;
+* ties are ordered by name.
+*/
+std::vector<std::pair<std::string, int>> getTopConsumedIngredients(size_t n) const;
+
+/**
+* Sets how many dishes a station can prepare in parallel.
+* @param station_name A string representing the station's name.
+* @param slots The number of parallel slots; must be at least 1.
+* @post: The station's slot count is updated. Stations default to 1 slot.
+* @return: True if the station was found and slots is valid; false otherwise.
+*/
+bool setStationSlots(const std::string& station_name, int slots);
+
+/**
+* Retrieves how many dishes a station can prepare in parallel.
+* @param station_name A string representing the station's name.
+* @return: The station's slot count (1 unless set).
+*/
+int getStationSlots(const std::string& station_name) const;
+
+/**
+* Sets how long a station takes to prepare a dish.
+* @param station_name A string representing the station's name.
+* @param dish_name A string representing the name of the dish.
+* @param prep_time The preparation time in minutes; must be at least 1.
+* @post: The station's prep time for the dish is updated. Prep times default to 1 minute.
+* @return: True if the station was found and prep_time is valid; false otherwise.
+*/
+bool setDishPrepTime(const std::string& station_name, const std::string& dish_name, int prep_time);
+
+/**
+* Retrieves how long a station takes to prepare a dish.
+* @param station_name A string representing the station's name.
+* @param dish_name A string representing the name of the dish.
+* @return: The prep time in minutes (1 unless set).
+*/
+int getDishPrepTime(const std::string& station_name, const std::string& dish_name) const;
+
+/**
+* Plans the first dishes of the queue across capable stations to minimize
+* the time until the whole batch is finished.
+* @param window The maximum number of dishes, from the front of the queue, to plan.
+* @pre: None.
+* @post: The queue and all stock are unchanged.
+* @return: One assignment per dish that could be placed, ordered by start time
+* and then queue position. Dishes that no station can prepare from its
+* current stock (given the rest of the plan) are left out.
+* Planning is longest-prep-first list scheduling followed by a bounded number
+* of improving moves off the busiest slot, so its runtime is polynomial in
+* the window and station count.
+*/
+std::vector<DishAssignment> planBatchAssignment(size_t window) const;
+
+/**
+* Plans the first dishes of the queue with planBatchAssignment and prepares them.
+* @param window The maximum number of dishes, from the front of the queue, to plan.
+* @post: Every planned dish is prepared at its assigned station and removed
+* from the queue. Dishes that were not prepared keep their relative order.
+* @return: The number of dishes prepared.
+*/
+int prepareQueuedBatch(size_t window);
+
+/**
+* Turns on consumption tracking and ahead-of-demand restocking.
+* @param policy The smoothing, low-water mark and horizon to use.
+* @post: Every prepare updates the station's per-ingredient consumption rate.
+* Rates already learned are kept.
+*/
+void setRestockPolicy(const RestockPolicy& policy);
+
+/**
+* Turns off consumption tracking and forgets the learned rates.
+* @post: restockAhead does nothing until setRestockPolicy is called again.
+*/
+void disableRestocking();
+
+/**
+* Retrieves a station's smoothed consumption of an ingredient.
+* @param station_name A string representing the station's name.
+* @param ingredient_name A string representing the name of the ingredient.
+* @return The expected quantity used per prepare at that station, or 0 if unknown.
+*/
+double getConsumptionRate(const std::string& station_name, const std::string& ingredient_name) const;
+
+/**
+* Moves stock from the backup to every station whose projected stock would
+* cross the low-water mark.
+* @pre: setRestockPolicy has been called.
+* @post: Each short station gets one transfer per ingredient, big enough to
+* bring its projection back up to the low-water mark. When the backup cannot
+* cover every request, stations are served in list order and the last one
+* gets what is left. The backup never goes below zero.
+* @return: The number of transfers made.
+*/
+int restockAhead();
+
 private:
+    // forks read the manager's state directly and replay onto it on commit
+    friend class KitchenFork;
+
+    // a mutex member that leaves StationManager copyable; copies get their own
+    template <class Mutex>
+    struct CopyableMutex {
+        mutable Mutex mutex;
+        CopyableMutex() {}
+        CopyableMutex(const CopyableMutex&) {}
+        CopyableMutex& operator=(const CopyableMutex&) { return *this; }
+    };
+
+    // holds the kitchen mutex for the calling thread, so a running
+    // BackgroundRestocker never sees stock mid-change; workers of
+    // processAllDishesParallel skip it, since their caller already holds it
+    class KitchenLock {
+    public:
+        explicit KitchenLock(const StationManager& manager);
+        ~KitchenLock();
+        KitchenLock(const KitchenLock&) = delete;
+        KitchenLock& operator=(const KitchenLock&) = delete;
+    private:
+        std::recursive_mutex* mutex_;
+    };
+
     // helper function to get index of a station by name
     int getStationIndex(const std::string& station_name) const;
+    // helper function to find a station's own copy of a dish by name
+    static Dish* findStationDish(KitchenStation* station, const std::string& dish_name);
+    // helper function running one queued dish through processAllDishes' station loop
+    bool processQueuedDish(Dish* dish, std::ostream& out);
+    // helpers keeping the inventory aggregates in step with stock mutations
+    void adjustStationTotal(const std::string& ingredient_name, int delta);
+    void adjustBackupTotal(const std::string& ingredient_name, int delta);
+    void addStationStockToTotals(KitchenStation* station, int sign);
+    void rebuildBackupTotals();
+
+    // ingredient name -> quantity, a working copy of a station's stock
+    typedef std::unordered_map<std::string, int> StockLevels;
+    static StockLevels getStockLevels(KitchenStation* station);
+    // true if stock covers one serving of the station's recipe
+    static bool hasStockFor(const StockLevels& stock, Dish* recipe);
+    // removes (or, with negative servings, returns) a recipe's ingredients
+    static void takeStock(StockLevels& stock, Dish* recipe, int servings);
+
+    // smoothed use of one ingredient, decayed lazily to the station's latest prepare
+    struct DemandRate {
+        double rate = 0;
+        unsigned long last_prepare = 0;
+    };
+    struct StationDemand {
+        unsigned long prepares = 0;
+        std::unordered_map<std::string, DemandRate> rates;
+    };
+    // folds one prepare of a recipe into the station's rates; caller holds inventory_mutex_
+    void recordDemand(const std::string& station_name, Dish* recipe);
+    double currentRate(const StationDemand& demand, const DemandRate& rate) const;
+    // folds one station's demand into another's, weighting rates by prepare count
+    void mergeDemand(const std::string& into_name, const std::string& from_name);
+    // takes up to quantity of an ingredient across backup entries; returns the amount taken
+    int takeFromBackup(const std::string& ingredient_name, int quantity, Ingredient& taken);
+
+    // parallel slot count and per-dish prep times of a station
+    struct StationProfile {
+        int slots = 1;
+        std::unordered_map<std::string, int> prep_times;
+    };
+
     std::queue<Dish*> dish_queue_;
     std::vector<Ingredient> backup_ingredients_;
+    // kitchen-wide inventory aggregates, keyed by ingredient name
+    std::unordered_map<std::string, int> station_totals_;
+    std::unordered_map<std::string, int> backup_totals_;
+    std::unordered_map<std::string, int> consumed_totals_;
+    // capacity profiles, keyed by station name
+    std::unordered_map<std::string, StationProfile> station_profiles_;
+    // bumped on every change to stock, the queue or the station list
+    unsigned long version_ = 0;
+
+    // demand-forecast restocking state, keyed by station name
+    bool restocking_enabled_ = false;
+    RestockPolicy restock_policy_;
+    std::unordered_map<std::string, StationDemand> station_demand_;
+
+    // guards the backup and the aggregates while groups run in parallel
+    CopyableMutex<std::mutex> inventory_mutex_;
+    // serializes the order path with a BackgroundRestocker
+    CopyableMutex<std::recursive_mutex> kitchen_mutex_;
 };
 
 #endif // STATIONMANAGER_HPP
@@ -0,0 +1,117 @@
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+
+// Parameterized Constructor
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : generation_(0), stopping_(false), remaining_(0)
+{
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < threads; ++i)
+    {
+        workers_.emplace_back(new Worker());
+    }
+    for (size_t i = 0; i < threads; ++i)
+    {
+        threads_.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+// Destructor
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &thread : threads_)
+    {
+        thread.join();
+    }
+}
+
+// Returns the number of worker threads
+size_t WorkStealingPool::size() const
+{
+    return workers_.size();
+}
+
+// Deals a batch across the workers and waits for it to drain
+void WorkStealingPool::run(const std::vector<std::function<void()>> &tasks)
+{
+    if (tasks.empty())
+    {
+        return;
+    }
+    remaining_ = tasks.size();
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        Worker &worker = *workers_[i % workers_.size()];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(&tasks[i]);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++generation_;
+    wake_.notify_all();
+    done_.wait(lock, [this]
+               { return remaining_ == 0; });
+}
+
+// Takes the newest own task, or the oldest task of another worker
+const std::function<void()> *WorkStealingPool::takeTask(size_t self)
+{
+    {
+        Worker &own = *workers_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty())
+        {
+            const std::function<void()> *task = own.tasks.back();
+            own.tasks.pop_back();
+            return task;
+        }
+    }
+    for (size_t offset = 1; offset < workers_.size(); ++offset)
+    {
+        Worker &victim = *workers_[(self + offset) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty())
+        {
+            const std::function<void()> *task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+// Waits for each batch and works until no task is left to take
+void WorkStealingPool::workerLoop(size_t self)
+{
+    unsigned long seen = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this, seen]
+                       { return stopping_ || generation_ != seen; });
+            if (stopping_)
+            {
+                return;
+            }
+            seen = generation_;
+        }
+        while (const std::function<void()> *task = takeTask(self))
+        {
+            (*task)();
+            if (--remaining_ == 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                done_.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef WORKSTEALINGPOOL_HPP
+#define WORKSTEALINGPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed-size pool of worker threads that run batches of tasks.
+ *
+ * Each worker has its own deque. A batch is dealt round-robin across the
+ * deques. A worker takes tasks from the back of its own deque and, once that
+ * is empty, steals from the front of the others. The order in which tasks run
+ * is therefore unspecified; callers that need a deterministic result must
+ * make their tasks independent.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * Parameterized Constructor
+     * @param threads The number of worker threads; 0 means one per hardware thread.
+     * @post: The workers are started and wait for a batch.
+     */
+    explicit WorkStealingPool(size_t threads);
+
+    /**
+     * Destructor
+     * @post: The workers are stopped and joined.
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * Runs a batch of tasks and waits for all of them to finish.
+     * @param tasks The tasks to run. They must not throw.
+     * @pre: run is not already in progress on this pool.
+     */
+    void run(const std::vector<std::function<void()>>& tasks);
+
+    /**
+     * @return The number of worker threads.
+     */
+    size_t size() const;
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<const std::function<void()>*> tasks;
+    };
+
+    // takes a task from the worker's own deque, or steals one from another
+    const std::function<void()>* takeTask(size_t self);
+    void workerLoop(size_t self);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    unsigned long generation_;
+    bool stopping_;
+    std::atomic<size_t> remaining_;
+};
+
+#endif // WORKSTEALINGPOOL_HPP